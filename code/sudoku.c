@@ -6,31 +6,376 @@
  *  version in provided PDF
 **********************************************/
 
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+// Output buffer size, large enough for a full screen or ~780 text records
+#define OUT_BUFFER_SIZE 65536
+
+// Fixed-size batch output records
+// - text: 81 cells ('.' for blank), a space, the result code and a newline
+// - binary: the result code byte followed by 81 cell bytes (0 for blank)
+#define RECORD_TEXT_SIZE 84
+#define RECORD_BINARY_SIZE 82
+
+// Records solved by a sharded batch run between journal checkpoints
+#define CHECKPOINT_RECORDS 4096
+
+// Bytes hashed from each end of a corpus to fingerprint it in journals
+#define FINGERPRINT_BLOCK 65536
+
+// Sizes of the --perf report: hardware counters and difficulty buckets
+#define PERF_COUNTERS 4
+#define PERF_BUCKETS 4
+
+// Events a trace ring holds, a power of two, and the trace file header
+#define TRACE_EVENTS (1 << 20)
+#define TRACE_MAGIC "SUDOKUT1"
+#define TRACE_HEADER_SIZE 194
+
+// Result codes returned by the deadline-bounded solver and file loader
+enum {
+    SOLVE_SOLVED = 0,
+    SOLVE_UNSOLVABLE,
+    SOLVE_MULTIPLE,
+    SOLVE_TIMEOUT,
+    SOLVE_MALFORMED
+};
+
+// Search engines, differing in how the next blank and digit are chosen
+// - mrv: propagates naked singles and branches on the fewest candidates
+// - linear: plain backtracking over blanks in reading order
+// - shuffle: mrv, with the digit order rotated by a seeded random number
+enum {
+    ENGINE_MRV = 0,
+    ENGINE_LINEAR,
+    ENGINE_SHUFFLE_1,
+    ENGINE_SHUFFLE_2,
+    ENGINES
+};
+
+// Printable names for each engine, also used in the portfolio stats file
+char engineNames[ENGINES][16] = {
+    "mrv",
+    "linear",
+    "shuffle-1",
+    "shuffle-2",
+};
+
+// Exit code for usage and file errors, kept apart from the result codes so
+// scripts reading a --solve exit code never mistake one for a result
+#define EXIT_ERROR 5
+
+// Printable names for each result code, indexed by code
+char statusNames[5][16] = {
+    "solved",
+    "unsolvable",
+    "multiple",
+    "timeout",
+    "malformed",
+};
+
+// Recorded place and undo events of a search, kept in a ring
+// - Each event packs the undo flag in bit 15, the cell in bits 4-10 and
+//   the digit in bits 0-3
+typedef struct {
+    unsigned short * events;        // Event k is in slot k % capacity
+    long long capacity;
+    long long first;                // Number of the oldest event held
+    long long count;                // Number of events recorded
+    long long solvedAt;             // Events up to the first solution, or -1
+    int givens[81];                 // The puzzle, row-major
+    int base[81];                   // Grid before event number first
+} Trace;
+
+// State shared by every level of the propagating search
+typedef struct {
+    int cell[81];                   // Grid in row-major order, 0 for blank
+    int solution[81];               // First complete grid found
+    unsigned short rowMask[9];      // Digits used in each row, bit n-1 for n
+    unsigned short colMask[9];      // Digits used in each column
+    unsigned short boxMask[9];      // Digits used in each 3x3 box
+    int solutions;                  // Number of solutions found
+    int solutionLimit;              // Solutions to find before stopping
+    long nodes;                     // Search nodes visited
+    struct timespec deadline;       // Monotonic time the search must end by
+    int hasDeadline;
+    int timedOut;
+    int engine;                     // ENGINE_* choosing blanks and digits
+    unsigned int seed;              // Random state for the shuffle engines
+    int * cancel;                   // Set by another thread to stop, or NULL
+    Trace * trace;                  // Records each place and undo, or NULL
+} SolveState;
+
+// Shared by the engines racing in solvePortfolio
+typedef struct {
+    int puzzle[9][9];               // Starting grid, read by every engine
+    int result[9][9];               // Grid from the winning engine
+    int status;                     // Result code of the winning engine
+    int winner;                     // Engine that answered first, -1 until then
+    int cancel;                     // Set once there is a winner
+    long deadlineMs;
+    pthread_mutex_t lock;           // Guards status, winner and result
+} Race;
+
+// One engine's entry in a Race
+typedef struct {
+    Race * race;
+    int engine;
+} Runner;
+
+// Reusable output buffer, flushed to its file descriptor in large writes
+typedef struct {
+    int fd;
+    size_t used;
+    char data[OUT_BUFFER_SIZE];
+} OutBuffer;
+
+// Batch progress saved in each journal checkpoint
+typedef struct {
+    long long records;      // Records completed by this shard
+    long long inOffset;     // Corpus byte offset of the next record
+    long long outBytes;     // Output bytes the completed records fill
+    long counts[5];         // Records finished with each result code
+} Checkpoint;
+
+// Hardware counters opened as one perf_event group
+typedef struct {
+    int fd[PERF_COUNTERS];  // -1 where a counter could not be opened
+    int leader;             // First counter opened, -1 if none
+} PerfGroup;
+
+// Shared buffer for everything the game draws on the terminal
+OutBuffer screen = { STDOUT_FILENO, 0, "" };
+
 int checkCol(int, int, int sudoku[9][9]);
 int checkRow(int, int, int sudoku[9][9]);
 int checkSquare(int, int, int, int sudoku[9][9]);
 int checkSingleSquare(int, int, int sudoku[9][9]);
 int getInput(char *);
 void printGrid(int sudoku[9][9], int error, int savestate[9][9]);
-void readFile(int sudoku[9][9], char *);
+int readFile(int sudoku[9][9], char *);
+int checkGivens(int sudoku[9][9]);
+int solveDeadline(int sudoku[9][9], long);
+int solveEngine(int sudoku[9][9], long, int, int *, Trace *);
+void initSearch(SolveState *, int);
+int runSearch(SolveState *, int sudoku[9][9], long);
+int solvePortfolio(int sudoku[9][9], long, int, char *);
+void * raceEngine(void *);
+void loadStats(char *, long wins[ENGINES], long races[ENGINES]);
+void readStats(FILE *, long wins[ENGINES], long races[ENGINES]);
+void recordRace(char *, int ran[], int, int);
+int searchGrid(SolveState *);
+int nextRandom(SolveState *, int);
+int countBits(unsigned int);
+int pastDeadline(SolveState *);
+void startDeadline(SolveState *, long);
+void placeDigit(SolveState *, int, int);
+void clearDigit(SolveState *, int);
 void play(int sudoku[9][9]);
 int validate(char [], int, int savestate[9][9]);
 int checkSolution(int sudoku[9][9]);
-int solvePuzzle(int sudoku[9][9], int, int, int savestate[9][9]);
+int solvePuzzle(int sudoku[9][9], int, int, SolveState *);
+void printSolution(int sudoku[9][9], int);
+void outFlush(OutBuffer *);
+void outWrite(OutBuffer *, const char *, size_t);
+void outText(OutBuffer *, const char *);
+void outFormat(OutBuffer *, const char *, ...);
+void outRecord(OutBuffer *, int sudoku[9][9], int, int);
+int parseLine(char *, int sudoku[9][9]);
+int runBatch(char *, char *, int, long, int, int);
+int readJournal(FILE *, char *, Checkpoint *, long long *);
+void writeCheckpoint(OutBuffer *, int, char *, Checkpoint *);
+int runMerge(char *, int);
+unsigned long long fingerprintCorpus(FILE *, long long);
+int openCounters(PerfGroup *);
+void readCounters(PerfGroup *, unsigned long long values[PERF_COUNTERS]);
+int runPerf(char *, long);
+Trace * newTrace(int sudoku[9][9]);
+void freeTrace(Trace *);
+void applyEvent(int grid[81], unsigned short, int);
+void traceEvent(Trace *, int, int, int);
+int saveTrace(char *, Trace *);
+Trace * loadTrace(char *);
+void seekTrace(Trace *, int grid[81], long long *, long long);
+void animateTrace(Trace *, int grid[81], long long *, long long, long);
+int runReplay(char *, long);
 
 // MAIN - Starting point of program
 // @params
 // - filename - pass the program the name of the file containing sudoku puzzle
+// - --solve - solve the puzzle without the game UI and print the result
+// - --deadline ms - give up on each solve after this many milliseconds
+// - --batch - solve a corpus file holding one 81-character puzzle per line
+// - --out file - write batch records to a file instead of the terminal
+// - --binary - write batch records in the binary record format
+// - --shard k/n - run the k-th of n shards of a batch, resumable
+// - --merge n - join the outputs of n finished shards into --out file
+// - --portfolio n - race n search engines on a --solve, first answer wins
+// - --stats file - keep portfolio win counts in this file
+// - --engine name - search engine for --solve (mrv, linear, shuffle-1/2)
+// - --trace file - record the --solve search into a trace file
+// - --replay file - step through a recorded trace
+// - --delay ms - pause between frames when playing a trace
+// - --perf - profile each solving engine on a corpus with hardware counters
 int main(int argc, char * argv[]){
 
-    if(argc != 2){
-        printf("Incorrect usage. Include sudoku puzzle file as ./sudoku [filename]");
-        exit(1);
+    char * filename = NULL;
+    char * outName = NULL;
+    int solveOnly = 0;
+    int batch = 0;
+    int binary = 0;
+    int shard = 0;
+    int shards = 0;
+    int merge = 0;
+    int perf = 0;
+    int portfolio = 0;
+    char * statsName = NULL;
+    char * traceName = NULL;
+    char * replayName = NULL;
+    int engine = ENGINE_MRV;
+    long delayMs = 0;
+    long deadlineMs = 0;
+    int engineSet = 0;
+    int delaySet = 0;
+    int deadlineSet = 0;
+    int badUsage = 0;
+
+    // Sort options from the puzzle filename
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--solve") == 0){
+            solveOnly = 1;
+        }
+        else if(strcmp(argv[i], "--deadline") == 0 && i + 1 < argc){
+            deadlineMs = atol(argv[++i]);
+            deadlineSet = 1;
+        }
+        else if(strcmp(argv[i], "--batch") == 0){
+            batch = 1;
+        }
+        else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc){
+            outName = argv[++i];
+        }
+        else if(strcmp(argv[i], "--binary") == 0){
+            binary = 1;
+        }
+        else if(strcmp(argv[i], "--shard") == 0 && i + 1 < argc){
+            if(sscanf(argv[++i], "%d/%d", &shard, &shards) != 2
+                    || shards < 1 || shard < 0 || shard >= shards){
+                printf("Shards are given as index/count, ex: --shard 0/4\n");
+                exit(EXIT_ERROR);
+            }
+        }
+        else if(strcmp(argv[i], "--portfolio") == 0 && i + 1 < argc){
+            portfolio = atoi(argv[++i]);
+            badUsage |= portfolio < 1;
+        }
+        else if(strcmp(argv[i], "--stats") == 0 && i + 1 < argc){
+            statsName = argv[++i];
+        }
+        else if(strcmp(argv[i], "--engine") == 0 && i + 1 < argc){
+            i++;
+            engine = ENGINES;
+            for(int j = 0; j < ENGINES; j++){
+                if(strcmp(argv[i], engineNames[j]) == 0){
+                    engine = j;
+                }
+            }
+            if(engine == ENGINES){
+                printf("Engines are mrv, linear, shuffle-1 and shuffle-2\n");
+                exit(EXIT_ERROR);
+            }
+            engineSet = 1;
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+            traceName = argv[++i];
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc){
+            replayName = argv[++i];
+        }
+        else if(strcmp(argv[i], "--delay") == 0 && i + 1 < argc){
+            delayMs = atol(argv[++i]);
+            delaySet = 1;
+        }
+        else if(strcmp(argv[i], "--perf") == 0){
+            perf = 1;
+        }
+        else if(strcmp(argv[i], "--merge") == 0 && i + 1 < argc){
+            merge = atoi(argv[++i]);
+            badUsage |= merge < 1;
+        }
+        // Unknown option, or an option missing its value
+        else if(strncmp(argv[i], "--", 2) == 0){
+            badUsage = 1;
+        }
+        else if(filename == NULL){
+            filename = argv[i];
+        }
+        else{
+            badUsage = 1;
+        }
+    }
+
+    // Only one mode at a time, and every option must belong to it. Replays
+    // and merges take no puzzle file, every other mode needs one.
+    int modes = solveOnly + batch + perf + (merge > 0) + (replayName != NULL);
+    int noPuzzle = merge > 0 || replayName != NULL;
+
+    if(modes > 1
+            || (filename == NULL) != noPuzzle
+            || (outName == NULL && (merge > 0 || shards > 0))
+            || (outName != NULL && !batch && merge == 0)
+            || ((binary || shards > 0) && !batch)
+            || (deadlineSet && !solveOnly && !batch && !perf)
+            || (delaySet && replayName == NULL)
+            || ((engineSet || traceName != NULL || portfolio > 0) && !solveOnly)
+            || (portfolio > 0 && (engineSet || traceName != NULL))
+            || (statsName != NULL && portfolio == 0)){
+        badUsage = 1;
+    }
+
+    if(badUsage){
+        printf("Incorrect usage. Include sudoku puzzle file as ./sudoku [filename]\n");
+        printf("or solve without playing as ./sudoku --solve [--deadline ms] [filename]\n");
+        printf("with --portfolio n [--stats file] to race n search engines\n");
+        printf("with --engine name to pick the search and --trace file to record it, replayed by ./sudoku --replay file [--delay ms]\n");
+        printf("or solve a corpus as ./sudoku --batch [--deadline ms] [--out file] [--binary] [corpus]\n");
+        printf("with --shard k/n --out file to run one resumable shard, then --merge n --out file\n");
+        printf("or profile the solvers on a corpus as ./sudoku --perf [--deadline ms] [corpus]\n");
+        exit(EXIT_ERROR);
+    }
+
+    if(replayName != NULL){
+        return runReplay(replayName, delayMs);
+    }
+
+    if(merge > 0){
+        return runMerge(outName, merge);
+    }
+
+    // Profiling reads a corpus like batch runs
+    if(perf){
+        return runPerf(filename, deadlineMs);
+    }
+
+    // Batch runs read their own corpus format
+    if(batch){
+        return runBatch(filename, outName, binary, deadlineMs, shard, shards);
     }
 
     // Initialize 9x9 sudoku grid
@@ -41,14 +386,68 @@ int main(int argc, char * argv[]){
         }
     }
 
-    // Get sudoku data from file
-    readFile(sudoku, argv[1]);
+    // Get sudoku data from file, rejecting bad layouts and conflicting givens
+    int status = readFile(sudoku, filename);
+
+    // Non-interactive solve, exit code is the result code
+    if(solveOnly){
+        int traceFailed = 0;
+
+        if(status == SOLVE_SOLVED && traceName != NULL){
+            Trace * trace = newTrace(sudoku);
+            status = solveEngine(sudoku, deadlineMs, engine, NULL, trace);
+            if(trace == NULL || saveTrace(traceName, trace) != 0){
+                fprintf(stderr, "Failed to record trace %s\n", traceName);
+                traceFailed = 1;
+            }
+            freeTrace(trace);
+        }
+        else if(status == SOLVE_SOLVED && portfolio > 0){
+            status = solvePortfolio(sudoku, deadlineMs, portfolio, statsName);
+        }
+        else if(status == SOLVE_SOLVED){
+            status = solveEngine(sudoku, deadlineMs, engine, NULL, NULL);
+        }
+        printSolution(sudoku, status);
+        return traceFailed ? EXIT_ERROR : status;
+    }
+
+    if(status != SOLVE_SOLVED){
+        printf("Invalid sudoku file %s\n", filename);
+        exit(EXIT_ERROR);
+    }
+
     // Begin game after puzzle is loaded
     play(sudoku);
 
     return 0;
 }
 
+// PRINT SOLUTION - prints a result code and grid in sudoku file format
+// @params
+//  - sudoku - the solved (or partially solved) 9x9 grid
+//  - status - result code returned by the solver
+void printSolution(int sudoku[9][9], int status){
+
+    outFormat(&screen, "%s\n", statusNames[status]);
+
+    // Grid is only meaningful when the solver produced one
+    if(status == SOLVE_SOLVED || status == SOLVE_MULTIPLE){
+
+        char line[18];
+
+        for(int i = 0; i < 9; i++){
+            for(int j = 0; j < 9; j++){
+                line[j * 2] = '0' + sudoku[i][j];
+                line[j * 2 + 1] = j < 8 ? ' ' : '\n';
+            }
+            outWrite(&screen, line, sizeof(line));
+        }
+    }
+
+    outFlush(&screen);
+}
+
 // VALIDATE - validates user input
 // @params
 //  - input - character string entered by user to be validated
@@ -234,11 +633,16 @@ int checkSquare(int x, int y, int num, int sudoku[9][9]){
 
 // SOLVE PUZZLE
 // - Solves a single 9x9 sudoku puzzle using recursive backtracing
+// - Kept as the baseline --perf compares the search engines against
 // @Params
 // - sudoku - a 9x9 sudoku grid to be solved
 // - int x - current x position in solution tree
 // - int y - current y position in solution tree
-int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
+// - state - counts the blank squares tried in nodes and stops the search,
+//   setting timedOut, once its deadline passes
+// Returns BOOLEAN INT
+// - 1 once the grid is solved, 0 if unsolvable or out of time
+int solvePuzzle(int sudoku[9][9], int x, int y, SolveState * state){
 
     int num = 1;
 
@@ -268,7 +672,7 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
         }
 
         // Recursively call solver on the next space because current space is a given
-        if(solvePuzzle(sudoku, x, y, savestate)) {
+        if(solvePuzzle(sudoku, x, y, state)) {
             return 1;
         }
         else{
@@ -276,6 +680,15 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
         }
     }
     
+    // Check the clock every 1024 blank squares, as searchGrid does
+    state->nodes++;
+    if((state->nodes & 1023) == 0 && pastDeadline(state)){
+        state->timedOut = 1;
+    }
+    if(state->timedOut){
+        return 0;
+    }
+
     // Begin finding solution for current blank space
     if(sudoku[x][y] == 0){
 
@@ -287,9 +700,6 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
                 // Place integer at current space
                 sudoku[x][y] = num;
 
-                // Live feed of solving!
-                printGrid(sudoku, 11, savestate);
-
                 // Final case: Reached last tile while passing sudoku rules
                 if(x == 8 && y == 8) {
                     return 1;
@@ -299,6 +709,7 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
                 // Using vx and vy to preserve x and y for incremented num
                 if(x < 8) {
                     vx = x + 1;
+                    vy = y;
                 }
 
                 // Do the same for y if at last x in grid
@@ -309,7 +720,7 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
                     }
                 }
                 // Test next position
-                if(solvePuzzle(sudoku, vx, vy, savestate)){
+                if(solvePuzzle(sudoku, vx, vy, state)){
                     return 1;
                 }
                 // If the test num doesn't work, we backtrack to the next num in while loop
@@ -327,452 +738,2330 @@ int solvePuzzle(int sudoku[9][9], int x, int y, int savestate[9][9]){
     }
 }
 
-// PRINT GRID - prints the sudoku grid
+// COUNT BITS - counts the candidate digits left in a mask
 // @params
-//  - sudoku - current 9x9 sudoku grid the user is playing with
-//  - error - error number to be printed along with grid UI
-void printGrid(int sudoku[9][9], int error, int savestate[9][9]){
+//  - mask - 9-bit digit mask, bit n-1 set for digit n
+// Returns INT
+//  - Number of bits set
+int countBits(unsigned int mask){
 
-    // Array of errors for printing with UI
-    char errors[10][100] = {
-        "",
-        ">>> Input Error: No input entered <<< ",
-        ">>> Input Error: Input too long <<<",
-        ">>> Input Error: Invalid character string <<<",
-        "> Sudoku numbers given at start cannot be changed <",
-        "Puzzle Reset!",
-        "> Puzzle has NOT been solved! <",
-        "",
-        "",
-        "",
-    };
+    int count = 0;
 
-    // Menu strings used to give user options
-    char menu[10][100] = {
-        "MENU",
-        "",
-        "",
-        "Enter a single integer to choose an option:",
-        "1. Reset Puzzle",
-        "2. Solve This Puzzle For Me",
-        "3. Resume Puzzle (exit menu)",
-        "4. Check My Solution",
-        "5. Quit Game",
-        "",
-    };
+    while(mask){
+        mask &= mask - 1;
+        count++;
+    }
 
-    // Main screen instructions
-    char inst[10][100] = {
-        "INSTRUCTIONS",
-        "Enter a three-digit string (ex: '1 9 5'). The first",
-        "number entered is the x(column), then y(row), and",
-        "finally the value you wish to place in the space.",
-        "Also, you may place a zero on a square to reset it.",
-        "Fill the grid so that every column, row, and 3x3",
-        "box contains every digit from 1 to 9.",
-        "Enter 'm' to open the menu options.",
-        "",
-        "",
-    };
+    return count;
+}
 
-    printf("\n");
-    system("clear");
+// PAST DEADLINE - checks the monotonic clock against the search deadline
+// @params
+//  - state - search state holding the deadline
+// Returns BOOLEAN INT
+//  - 1 once the deadline has passed
+int pastDeadline(SolveState * state){
 
-    // Check if the menu has been requested
-    if(error == 9){
-        printf("\t\t\t   - = S U D O K U = -     \t\t\t    %s\n\n", menu[0]);
+    struct timespec now;
+
+    if(!state->hasDeadline){
+        return 0;
     }
 
-    // Otherwise leave main screen instructions
-    else{
-        printf("\t\t\t   - = S U D O K U = -  \t\t\t%s\n\n", inst[0]);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if(now.tv_sec != state->deadline.tv_sec){
+        return now.tv_sec > state->deadline.tv_sec;
     }
 
+    return now.tv_nsec >= state->deadline.tv_nsec;
+}
 
-    printf("\t\t\t+-------+-------+-------+");
+// START DEADLINE - Sets a search to end a number of milliseconds from now
+// @params
+//  - state - search state to hold the deadline
+//  - deadlineMs - milliseconds allowed, 0 or less for no limit
+void startDeadline(SolveState * state, long deadlineMs){
 
-    // Begin printing bulk of screen
-    for(int i = 0; i < 9 ; i++){
+    if(deadlineMs <= 0){
+        return;
+    }
 
-        // Y-axis
-        printf("\n\t\t    %d   |", (9 - i));
+    clock_gettime(CLOCK_MONOTONIC, &state->deadline);
+    state->deadline.tv_sec += deadlineMs / 1000;
+    state->deadline.tv_nsec += (deadlineMs % 1000) * 1000000;
+    if(state->deadline.tv_nsec >= 1000000000){
+        state->deadline.tv_sec++;
+        state->deadline.tv_nsec -= 1000000000;
+    }
+    state->hasDeadline = 1;
+}
 
-        // Print numbers
-        for(int j = 0; j < 9; j++){
+// PLACE DIGIT - writes a digit into the search grid and its unit masks
+// @params
+//  - state - search state
+//  - i - cell index in row-major order
+//  - num - digit 1 through 9
+void placeDigit(SolveState * state, int i, int num){
 
-            // Print a simple . for empty spaces
-            if(sudoku[i][j] == 0){
-                printf(" .");
-            }
-            // Otherwise print given numbers
-            else{
+    unsigned short bit = 1 << (num - 1);
 
-                if(error == 10){
-                    printf("\033[0;32m");
-                }
+    state->cell[i] = num;
+    state->rowMask[i / 9] |= bit;
+    state->colMask[i % 9] |= bit;
+    state->boxMask[(i / 27) * 3 + (i % 9) / 3] |= bit;
 
-                if(sudoku[i][j] == savestate[i][j] && error != 11){
-                    printf("\033[0;32m");
-                    printf(" %d", sudoku[i][j]);
-                    printf("\033[0;0m");
-                }
-                else{
-                    printf(" %d", sudoku[i][j]);
-                }
+    if(state->trace != NULL){
+        traceEvent(state->trace, i, num, 0);
+    }
+}
 
-                if(error == 10){
-                    printf("\033[0;0m");
-                }
-            }
-            // Print grid separators
-            if((j + 1) % 3 == 0){
-                printf(" |");
-            }
-            // Print either menu or instructions based on specification
-            if(j == 8){
-                if(error == 9){
-                    printf("\t%s", menu[i + 1]);
-                }
+// CLEAR DIGIT - removes a digit placed by placeDigit
+// @params
+//  - state - search state
+//  - i - cell index in row-major order
+void clearDigit(SolveState * state, int i){
 
-                else{
-                    printf("\t%s", inst[i + 1]);
-                }
-            }
-        }
+    unsigned short bit = ~(1 << (state->cell[i] - 1));
 
-        if((i + 1) % 3 == 0){
-            printf("\n\t\t\t+-------+-------+-------+");
-        }
+    state->rowMask[i / 9] &= bit;
+    state->colMask[i % 9] &= bit;
+    state->boxMask[(i / 27) * 3 + (i % 9) / 3] &= bit;
+
+    if(state->trace != NULL){
+        traceEvent(state->trace, i, state->cell[i], 1);
     }
-    // Errors are printed here
-    printf("\n\t\t\t\t\t\t\t    %s", errors[error]);
-    // X-Axis
-    printf("\n\t\t\t  1 2 3   4 5 6   7 8 9\t\t> ");
 
+    state->cell[i] = 0;
 }
 
-// PLAY - Initializes the game
+// SEARCH GRID - Propagating search that counts up to two solutions
+// - Fills every blank with a single candidate left (naked singles) until
+//   none remain, fails as soon as any blank has no candidates, then
+//   branches on the blank with the fewest candidates
+// - The linear engine skips propagation and branches on the first blank
+// - Shuffle engines start each scan for the most constrained blank, and
+//   each blank's digits, at random points, so ties are broken differently
+//   and their search trees differ from mrv's
 // @params
-//  - sudoku - takes the 9x9 sudoku grid loaded from the file
-void play(int sudoku[9][9]){
-
-    int solved = 0;
-    int quit = 0;
-    char input[64];
-    int error = 0;
-    int message = 0;
-
-    // Create savestate for resetting the grid to start
-    int savestate[9][9];
-    for(int i = 0 ; i < 9; i++){
-        for(int j = 0; j < 9; j++){
-            savestate[i][j] = sudoku[i][j];
+//  - state - search state with the grid and unit masks loaded
+// Returns BOOLEAN INT
+//  - 1 when the search should stop (second solution found, timed out or
+//    cancelled)
+int searchGrid(SolveState * state){
+
+    // Cells filled by propagation at this level, undone before returning
+    int trail[81];
+    int filled = 0;
+    int stop = 0;
+    int best = -1;
+    unsigned int bestMask = 0;
+
+    // Check the clock and cancel flag every 1024 nodes to keep the common
+    // path cheap
+    state->nodes++;
+    if((state->nodes & 1023) == 0){
+        if(pastDeadline(state)
+                || (state->cancel != NULL && __atomic_load_n(state->cancel, __ATOMIC_RELAXED))){
+            state->timedOut = 1;
         }
     }
+    if(state->timedOut){
+        return 1;
+    }
 
-    // Game Start
-    while (solved == 0 && quit == 0){
-
-        error = 0;
+    // Blank to start scanning from, the first one for mrv and linear
+    int start = state->seed != 0 ? nextRandom(state, 81) : 0;
 
-        // Check messages for printing to user
-        if(message > 0){
-            if (message == 1){
-                error = 5;
-            }
+    while(1){
 
-            if (message == 2){
-                error = 6;
-            }
-            //reset
-            message = 0;
-        }
+        int bestCount = 10;
+        best = -1;
 
-        // Print grid to screen
-        printGrid(sudoku, error, savestate);
+        for(int k = 0; k < 81; k++){
 
-        // Get user input and validate
-        memset(input, '\0', 64);
-        fgets(input, 63, stdin);
-        error = validate(input, 1, savestate);
+            int i = start + k < 81 ? start + k : start + k - 81;
 
-        // Reprint the grid if there are errors
-        if(error != 0 && error != 9){
+            if(state->cell[i] != 0){
+                continue;
+            }
 
-            // Keep printing until input is properly inputted
-            while(error != 0){
+            unsigned int mask = ~(state->rowMask[i / 9] | state->colMask[i % 9]
+                    | state->boxMask[(i / 27) * 3 + (i % 9) / 3]) & 0x1FF;
+            int count = countBits(mask);
 
-                printGrid(sudoku, error, savestate);
+            // Contradiction: this blank can no longer be filled
+            if(count == 0){
+                best = -2;
+                break;
+            }
 
-                memset(input, '\0', 64);
-                fgets(input, 63, stdin);
-                error = validate(input, 1, savestate);
+            if(count < bestCount){
+                best = i;
+                bestMask = mask;
+                bestCount = count;
 
-                // Break if user requests the menu
-                if(error == 9){
+                if(count == 1 || state->engine == ENGINE_LINEAR){
                     break;
                 }
             }
         }
 
-        // Enter the menu
-        if (error == 9){
+        // Only one digit fits, place it and keep propagating
+        if(best >= 0 && bestCount == 1 && state->engine != ENGINE_LINEAR){
+            int num = 1;
+            while(!(bestMask & (1 << (num - 1)))){
+                num++;
+            }
+            placeDigit(state, best, num);
+            trail[filled++] = best;
+            continue;
+        }
 
-            printGrid(sudoku, error, savestate);
-            memset(input, '\0', 64);
-            fgets(input, 63, stdin);
+        break;
+    }
 
+    // Every blank is filled, record the grid
+    if(best == -1){
+        if(state->solutions == 0){
+            memcpy(state->solution, state->cell, sizeof(state->cell));
+            // Traces end at the first solution, the search for a second one
+            // is not recorded
+            if(state->trace != NULL){
+                state->trace->solvedAt = state->trace->count;
+                state->trace = NULL;
+            }
+        }
+        state->solutions++;
+        stop = state->solutions >= state->solutionLimit;
+    }
 
-            while(validate(input, 2, savestate) != 0){
+    // Branch on each candidate of the most constrained blank
+    else if(best >= 0){
 
-                printGrid(sudoku, error, savestate);
-                memset(input, '\0', 64);
-                fgets(input, 63, stdin);
+        // Shuffle engines start from a random digit and wrap around
+        int first = state->seed != 0 ? nextRandom(state, 9) : 0;
 
+        for(int k = 0; k < 9 && !stop; k++){
+            int num = (first + k) % 9 + 1;
+            if(bestMask & (1 << (num - 1))){
+                placeDigit(state, best, num);
+                stop = searchGrid(state);
+                clearDigit(state, best);
             }
+        }
+    }
 
-            // Reset board
-            if(input[0] == '1'){
-                for (int i = 0; i < 9; i++){
-                    for (int j = 0; j < 9; j++){
-                        sudoku[i][j] = savestate[i][j];
-                        message = 1;
-                    }
-                }
-            }
+    // Undo propagation before handing the grid back to the parent
+    while(filled > 0){
+        clearDigit(state, trail[--filled]);
+    }
 
-            // Solve Puzzle!
-            if(input[0] == '2'){
+    return stop;
+}
 
-                // Reset board to solve the puzzle
-                for (int i = 0; i < 9; i++){
-                    for (int j = 0; j < 9; j++){
-                        sudoku[i][j] = savestate[i][j];
-                        //message = 1;
-                    }
-                }
-                solved = solvePuzzle(sudoku, 0, 0, savestate);
-                printGrid(sudoku, 10, savestate);
+// NEXT RANDOM - Steps a shuffle engine's xorshift generator
+// @params
+//  - state - search state holding a nonzero seed
+//  - range - number of values to choose from
+// Returns INT
+//  - A value from 0 to range - 1
+int nextRandom(SolveState * state, int range){
 
-                printf("\033[0;32m");
-                printf("\n\n\t\t\t\tPuzzle has been solved by computer!");
-                printf("\033[0;0m");
-                printf("\n(exited)\n");
-            }
+    state->seed ^= state->seed << 13;
+    state->seed ^= state->seed >> 17;
+    state->seed ^= state->seed << 5;
 
-            // Check solution
-            if(input[0] == '4'){
+    return state->seed % range;
+}
 
-                solved = checkSolution(sudoku);
+// SOLVE DEADLINE - Solves a puzzle within a time budget
+// - Unlike solvePuzzle, this never claims success it has not found and
+//   keeps searching after the first solution to detect multiple solutions
+// @params
+//  - sudoku - 9x9 grid, overwritten with the first solution when found
+//  - deadlineMs - milliseconds allowed, 0 or less for no limit
+// Returns INT
+//  - SOLVE_SOLVED, SOLVE_UNSOLVABLE, SOLVE_MULTIPLE, SOLVE_TIMEOUT or
+//    SOLVE_MALFORMED
+int solveDeadline(int sudoku[9][9], long deadlineMs){
 
-                if(solved == 1){
-                    printf("\033[0;32m");
-                    printf("\n\t\t\t\t\tYou've done it!\nThx4Playing!\n");
-                    printf("\033[0;0m");
-                    printf("\n(exited)\n");
+    return solveEngine(sudoku, deadlineMs, ENGINE_MRV, NULL, NULL);
+}
+
+// SOLVE ENGINE - Solves a puzzle within a time budget with a chosen engine
+// @params
+//  - sudoku - 9x9 grid, overwritten with the first solution when found
+//  - deadlineMs - milliseconds allowed, 0 or less for no limit
+//  - engine - ENGINE_* to search with
+//  - cancel - flag another thread sets to stop the search, or NULL. A
+//    cancelled search returns SOLVE_TIMEOUT.
+//  - trace - trace from newTrace to record the search into, or NULL
+// Returns INT
+//  - Result code, as for solveDeadline
+int solveEngine(int sudoku[9][9], long deadlineMs, int engine, int * cancel, Trace * trace){
+
+    SolveState state;
+
+    initSearch(&state, engine);
+    state.cancel = cancel;
+    state.trace = trace;
+
+    return runSearch(&state, sudoku, deadlineMs);
+}
+
+// INIT SEARCH - Prepares an empty search state for an engine
+// - Callers may then set the cancel flag, trace and solution limit before
+//   runSearch. The limit defaults to 2 to tell unique puzzles from ones
+//   with multiple solutions, a limit of 1 stops at the first solution and
+//   reports it as solved.
+// @params
+//  - state - the search state to reset
+//  - engine - ENGINE_* to search with
+void initSearch(SolveState * state, int engine){
+
+    memset(state, 0, sizeof(SolveState));
+    state->engine = engine;
+    state->solutionLimit = 2;
+
+    // Each shuffle engine gets its own fixed seed
+    if(engine >= ENGINE_SHUFFLE_1){
+        state->seed = 2463534242u + engine;
+    }
+}
+
+// RUN SEARCH - Loads a puzzle into a prepared search state and solves it
+// - The state keeps its node count afterwards for profiling
+// @params
+//  - state - search state from initSearch
+//  - sudoku - 9x9 grid, overwritten with the first solution when found
+//  - deadlineMs - milliseconds allowed, 0 or less for no limit
+// Returns INT
+//  - Result code, as for solveDeadline
+int runSearch(SolveState * state, int sudoku[9][9], long deadlineMs){
+
+    Trace * trace = state->trace;
+
+    // Givens that already break the rules can never be solved
+    if(checkGivens(sudoku) != 0){
+        return SOLVE_MALFORMED;
+    }
+
+    startDeadline(state, deadlineMs);
+
+    // Givens are the trace's starting grid, only the search is recorded
+    state->trace = NULL;
+    for(int i = 0; i < 81; i++){
+        if(sudoku[i / 9][i % 9] != 0){
+            placeDigit(state, i, sudoku[i / 9][i % 9]);
+        }
+    }
+    state->trace = trace;
+
+    searchGrid(state);
+
+    // A solution found before the deadline is still returned
+    if(state->solutions > 0){
+        for(int i = 0; i < 81; i++){
+            sudoku[i / 9][i % 9] = state->solution[i];
+        }
+    }
+
+    if(state->timedOut && state->solutions < state->solutionLimit){
+        return SOLVE_TIMEOUT;
+    }
+    if(state->solutions == 0){
+        return SOLVE_UNSOLVABLE;
+    }
+    if(state->solutions == 1){
+        return SOLVE_SOLVED;
+    }
+
+    return SOLVE_MULTIPLE;
+}
+
+// RACE ENGINE - Thread body for one engine of a portfolio race
+// @params
+//  - arg - the Runner naming the race and engine
+// Returns
+//  - NULL
+void * raceEngine(void * arg){
+
+    Runner * runner = arg;
+    Race * race = runner->race;
+    int sudoku[9][9];
+    SolveState state;
+
+    memcpy(sudoku, race->puzzle, sizeof(sudoku));
+
+    // Racers stop at the first solution, uniqueness is checked once by
+    // solvePortfolio after the race
+    initSearch(&state, runner->engine);
+    state.solutionLimit = 1;
+    state.cancel = &race->cancel;
+
+    int status = runSearch(&state, sudoku, race->deadlineMs);
+
+    // First finished answer wins and cancels the others; timeouts never win
+    pthread_mutex_lock(&race->lock);
+    if(race->winner < 0 && status != SOLVE_TIMEOUT){
+        race->winner = runner->engine;
+        race->status = status;
+        memcpy(race->result, sudoku, sizeof(sudoku));
+        __atomic_store_n(&race->cancel, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&race->lock);
+
+    return NULL;
+}
+
+// READ STATS - Parses portfolio win counts from an open stats file
+// - Each line holds an engine name, its wins and the races it ran in
+// @params
+//  - statsFD - the stats file, positioned at the start
+//  - wins - filled with the wins of each engine
+//  - races - filled with the races each engine ran in
+void readStats(FILE * statsFD, long wins[ENGINES], long races[ENGINES]){
+
+    char line[128];
+    char name[16];
+    long won, ran;
+
+    for(int i = 0; i < ENGINES; i++){
+        wins[i] = 0;
+        races[i] = 0;
+    }
+
+    while(statsFD != NULL && fgets(line, sizeof(line), statsFD)){
+        if(sscanf(line, "%15s %ld %ld", name, &won, &ran) != 3){
+            continue;
+        }
+        for(int i = 0; i < ENGINES; i++){
+            if(strcmp(name, engineNames[i]) == 0){
+                wins[i] = won;
+                races[i] = ran;
+            }
+        }
+    }
+}
+
+// LOAD STATS - Reads portfolio win counts from the stats file
+// - Holds a shared lock while reading, so a concurrent recordRace is never
+//   seen half written
+// @params
+//  - statsName - name of the stats file, or NULL to start from zero
+//  - wins - filled with the wins of each engine
+//  - races - filled with the races each engine ran in
+void loadStats(char * statsName, long wins[ENGINES], long races[ENGINES]){
+
+    FILE * statsFD = statsName != NULL ? fopen(statsName, "r") : NULL;
+
+    if(statsFD != NULL && flock(fileno(statsFD), LOCK_SH) != 0){
+        fclose(statsFD);
+        statsFD = NULL;
+    }
+
+    readStats(statsFD, wins, races);
+
+    // Closing the file releases the lock
+    if(statsFD != NULL){
+        fclose(statsFD);
+    }
+}
+
+// RECORD RACE - Adds one race's result to the stats file
+// - The file is locked, reread and rewritten in place, so processes racing
+//   concurrently add to each other's counts rather than overwriting them
+// @params
+//  - statsName - name of the stats file, or NULL to keep nothing
+//  - ran - engines that took part
+//  - count - number of engines in ran
+//  - winner - engine that won, or -1 if none did
+void recordRace(char * statsName, int ran[], int count, int winner){
+
+    long wins[ENGINES], races[ENGINES];
+
+    if(statsName == NULL){
+        return;
+    }
+
+    int fd = open(statsName, O_RDWR | O_CREAT, 0644);
+    FILE * statsFD = fd >= 0 ? fdopen(fd, "r+") : NULL;
+    if(statsFD == NULL || flock(fd, LOCK_EX) != 0){
+        fprintf(stderr, "Failed to open file %s\n", statsName);
+        if(statsFD != NULL){
+            fclose(statsFD);
+        }
+        else if(fd >= 0){
+            close(fd);
+        }
+        return;
+    }
+
+    readStats(statsFD, wins, races);
+
+    for(int i = 0; i < count; i++){
+        races[ran[i]]++;
+    }
+    if(winner >= 0){
+        wins[winner]++;
+    }
+
+    rewind(statsFD);
+    for(int i = 0; i < ENGINES; i++){
+        fprintf(statsFD, "%s %ld %ld\n", engineNames[i], wins[i], races[i]);
+    }
+    fflush(statsFD);
+
+    // Drop anything left over from a longer previous version
+    if(ftruncate(fd, ftello(statsFD)) != 0){
+        perror("ftruncate");
+    }
+
+    fclose(statsFD);
+}
+
+// SOLVE PORTFOLIO - Races several engines on one puzzle, one thread each
+// - The engines with the best recorded win rates are started, best first.
+//   The first to find a solution, or prove there is none, answers for all
+//   of them and the rest are cancelled at their next check of the cancel
+//   flag. A solution is then checked for uniqueness once by mrv, within
+//   what is left of the deadline.
+// @params
+//  - sudoku - 9x9 grid, overwritten with the first solution when found
+//  - deadlineMs - milliseconds allowed, 0 or less for no limit
+//  - count - number of engines to race, 1 to ENGINES
+//  - statsName - file keeping each engine's wins, or NULL
+// Returns INT
+//  - Result code of the winning engine, as for solveDeadline
+int solvePortfolio(int sudoku[9][9], long deadlineMs, int count, char * statsName){
+
+    Race race;
+    Runner runners[ENGINES];
+    pthread_t threads[ENGINES];
+    long wins[ENGINES], races[ENGINES];
+    int order[ENGINES];
+    int started = 0;
+    struct timespec begin, end;
+
+    if(checkGivens(sudoku) != 0){
+        return SOLVE_MALFORMED;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    if(count < 1){
+        count = 1;
+    }
+    if(count > ENGINES){
+        count = ENGINES;
+    }
+
+    // Order engines by win rate, starting each at 1 win in 2 races so new
+    // engines get tried. Ties keep the default order.
+    loadStats(statsName, wins, races);
+    for(int i = 0; i < ENGINES; i++){
+        int j = i;
+        while(j > 0 && (wins[i] + 1) * (races[order[j - 1]] + 2)
+                > (wins[order[j - 1]] + 1) * (races[i] + 2)){
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    memcpy(race.puzzle, sudoku, sizeof(race.puzzle));
+    race.status = SOLVE_TIMEOUT;
+    race.winner = -1;
+    race.cancel = 0;
+    race.deadlineMs = deadlineMs;
+    pthread_mutex_init(&race.lock, NULL);
+
+    for(int i = 0; i < count; i++){
+        runners[i].race = &race;
+        runners[i].engine = order[i];
+        if(pthread_create(&threads[i], NULL, raceEngine, &runners[i]) != 0){
+            break;
+        }
+        started++;
+    }
+
+    // No threads at all, run the favourite engine here instead
+    if(started == 0){
+        raceEngine(&runners[0]);
+    }
+
+    for(int i = 0; i < started; i++){
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&race.lock);
+
+    if(race.winner >= 0){
+        memcpy(sudoku, race.result, sizeof(race.result));
+    }
+    recordRace(statsName, order, started > 0 ? started : 1, race.winner);
+
+    // Search on for a second solution, keeping the winner's grid
+    if(race.status == SOLVE_SOLVED){
+
+        long remainingMs = 0;
+        int check[9][9];
+
+        if(deadlineMs > 0){
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            remainingMs = deadlineMs - (end.tv_sec - begin.tv_sec) * 1000
+                    - (end.tv_nsec - begin.tv_nsec) / 1000000;
+            if(remainingMs < 1){
+                remainingMs = 1;
+            }
+        }
+
+        memcpy(check, race.puzzle, sizeof(check));
+        return solveDeadline(check, remainingMs);
+    }
+
+    return race.status;
+}
+
+// OUT FLUSH - writes everything held in an output buffer
+// @params
+//  - out - the output buffer to be emptied
+void outFlush(OutBuffer * out){
+
+    size_t done = 0;
+
+    // Anything left in stdio must reach the terminal before the buffer does
+    if(out->fd == STDOUT_FILENO){
+        fflush(stdout);
+    }
+
+    while(done < out->used){
+        ssize_t n = write(out->fd, out->data + done, out->used - done);
+        if(n < 0){
+            perror("write");
+            exit(EXIT_ERROR);
+        }
+        done += n;
+    }
+
+    out->used = 0;
+}
+
+// OUT WRITE - appends bytes to an output buffer, flushing when full
+// - Data too large to fit goes out together with the buffered bytes in a
+//   single writev rather than being copied through the buffer
+// @params
+//  - out - the output buffer
+//  - data - bytes to append
+//  - len - number of bytes
+void outWrite(OutBuffer * out, const char * data, size_t len){
+
+    if(len <= OUT_BUFFER_SIZE - out->used){
+        memcpy(out->data + out->used, data, len);
+        out->used += len;
+        return;
+    }
+
+    if(len < OUT_BUFFER_SIZE){
+        outFlush(out);
+        memcpy(out->data, data, len);
+        out->used = len;
+        return;
+    }
+
+    if(out->fd == STDOUT_FILENO){
+        fflush(stdout);
+    }
+
+    struct iovec iov[2] = {
+        { out->data, out->used },
+        { (void *) data, len },
+    };
+    int count = 2;
+    struct iovec * next = iov;
+
+    // Resume after partial writes until both pieces are out
+    while(count > 0){
+        ssize_t n = writev(out->fd, next, count);
+        if(n < 0){
+            perror("writev");
+            exit(EXIT_ERROR);
+        }
+        while(count > 0 && (size_t) n >= next->iov_len){
+            n -= next->iov_len;
+            next++;
+            count--;
+        }
+        if(count > 0){
+            next->iov_base = (char *) next->iov_base + n;
+            next->iov_len -= n;
+        }
+    }
+
+    out->used = 0;
+}
+
+// OUT TEXT - appends a string to an output buffer
+// @params
+//  - out - the output buffer
+//  - text - null-terminated string to append
+void outText(OutBuffer * out, const char * text){
+
+    outWrite(out, text, strlen(text));
+}
+
+// OUT FORMAT - printf into an output buffer
+// @params
+//  - out - the output buffer
+//  - format - printf format string followed by its arguments
+void outFormat(OutBuffer * out, const char * format, ...){
+
+    va_list args;
+    size_t room = OUT_BUFFER_SIZE - out->used;
+
+    va_start(args, format);
+    int n = vsnprintf(out->data + out->used, room, format, args);
+    va_end(args);
+
+    // Did not fit, empty the buffer and format again
+    if(n >= 0 && (size_t) n >= room){
+        outFlush(out);
+        va_start(args, format);
+        n = vsnprintf(out->data, OUT_BUFFER_SIZE, format, args);
+        va_end(args);
+        if(n >= OUT_BUFFER_SIZE){
+            n = OUT_BUFFER_SIZE - 1;
+        }
+    }
+
+    if(n > 0){
+        out->used += n;
+    }
+}
+
+// OUT RECORD - appends one fixed-size batch record
+// @params
+//  - out - the output buffer
+//  - sudoku - the solved grid, or the puzzle as loaded if unsolved
+//  - status - result code for the puzzle
+//  - binary - 1 for the binary record format, 0 for text
+void outRecord(OutBuffer * out, int sudoku[9][9], int status, int binary){
+
+    char record[RECORD_TEXT_SIZE];
+
+    if(binary){
+        record[0] = status;
+        for(int i = 0; i < 81; i++){
+            record[i + 1] = sudoku[i / 9][i % 9];
+        }
+        outWrite(out, record, RECORD_BINARY_SIZE);
+        return;
+    }
+
+    for(int i = 0; i < 81; i++){
+        record[i] = sudoku[i / 9][i % 9] ? '0' + sudoku[i / 9][i % 9] : '.';
+    }
+    record[81] = ' ';
+    record[82] = '0' + status;
+    record[83] = '\n';
+
+    outWrite(out, record, RECORD_TEXT_SIZE);
+}
+
+// PRINT GRID - prints the sudoku grid
+// @params
+//  - sudoku - current 9x9 sudoku grid the user is playing with
+//  - error - error number to be printed along with grid UI
+void printGrid(int sudoku[9][9], int error, int savestate[9][9]){
+
+    // Array of errors for printing with UI
+    char errors[12][100] = {
+        "",
+        ">>> Input Error: No input entered <<< ",
+        ">>> Input Error: Input too long <<<",
+        ">>> Input Error: Invalid character string <<<",
+        "> Sudoku numbers given at start cannot be changed <",
+        "Puzzle Reset!",
+        "> Puzzle has NOT been solved! <",
+        "> This puzzle has no solution! <",
+        "",
+        "",
+        "",
+        "",
+    };
+
+    // Menu strings used to give user options
+    char menu[10][100] = {
+        "MENU",
+        "",
+        "",
+        "Enter a single integer to choose an option:",
+        "1. Reset Puzzle",
+        "2. Solve This Puzzle For Me",
+        "3. Resume Puzzle (exit menu)",
+        "4. Check My Solution",
+        "5. Quit Game",
+        "",
+    };
+
+    // Main screen instructions
+    char inst[10][100] = {
+        "INSTRUCTIONS",
+        "Enter a three-digit string (ex: '1 9 5'). The first",
+        "number entered is the x(column), then y(row), and",
+        "finally the value you wish to place in the space.",
+        "Also, you may place a zero on a square to reset it.",
+        "Fill the grid so that every column, row, and 3x3",
+        "box contains every digit from 1 to 9.",
+        "Enter 'm' to open the menu options.",
+        "",
+        "",
+    };
+
+    // Clear the terminal with escape codes in the same write as the grid
+    outText(&screen, "\n\033[H\033[2J\033[3J");
+
+    // Check if the menu has been requested
+    if(error == 9){
+        outFormat(&screen, "\t\t\t   - = S U D O K U = -     \t\t\t    %s\n\n", menu[0]);
+    }
+
+    // Otherwise leave main screen instructions
+    else{
+        outFormat(&screen, "\t\t\t   - = S U D O K U = -  \t\t\t%s\n\n", inst[0]);
+    }
+
+
+    outText(&screen, "\t\t\t+-------+-------+-------+");
+
+    // Begin printing bulk of screen
+    for(int i = 0; i < 9 ; i++){
+
+        // Y-axis
+        outFormat(&screen, "\n\t\t    %d   |", (9 - i));
+
+        // Print numbers
+        for(int j = 0; j < 9; j++){
+
+            // Print a simple . for empty spaces
+            if(sudoku[i][j] == 0){
+                outText(&screen, " .");
+            }
+            // Otherwise print given numbers
+            else{
+
+                if(error == 10){
+                    outText(&screen, "\033[0;32m");
+                }
+
+                if(sudoku[i][j] == savestate[i][j] && error != 11){
+                    outText(&screen, "\033[0;32m");
+                    outFormat(&screen, " %d", sudoku[i][j]);
+                    outText(&screen, "\033[0;0m");
                 }
                 else{
-                    message = 2;
+                    outFormat(&screen, " %d", sudoku[i][j]);
                 }
+
+                if(error == 10){
+                    outText(&screen, "\033[0;0m");
+                }
+            }
+            // Print grid separators
+            if((j + 1) % 3 == 0){
+                outText(&screen, " |");
             }
+            // Print either menu or instructions based on specification
+            if(j == 8){
+                if(error == 9){
+                    outFormat(&screen, "\t%s", menu[i + 1]);
+                }
+
+                else{
+                    outFormat(&screen, "\t%s", inst[i + 1]);
+                }
+            }
+        }
+
+        if((i + 1) % 3 == 0){
+            outText(&screen, "\n\t\t\t+-------+-------+-------+");
+        }
+    }
+    // Errors are printed here
+    outFormat(&screen, "\n\t\t\t\t\t\t\t    %s", errors[error]);
+    // X-Axis
+    outText(&screen, "\n\t\t\t  1 2 3   4 5 6   7 8 9\t\t> ");
+
+    // Whole screen goes out in a single write
+    outFlush(&screen);
+}
+
+// PLAY - Initializes the game
+// @params
+//  - sudoku - takes the 9x9 sudoku grid loaded from the file
+void play(int sudoku[9][9]){
+
+    int solved = 0;
+    int quit = 0;
+    char input[64];
+    int error = 0;
+    int message = 0;
+
+    // Create savestate for resetting the grid to start
+    int savestate[9][9];
+    for(int i = 0 ; i < 9; i++){
+        for(int j = 0; j < 9; j++){
+            savestate[i][j] = sudoku[i][j];
+        }
+    }
+
+    // Game Start
+    while (solved == 0 && quit == 0){
+
+        error = 0;
+
+        // Check messages for printing to user
+        if(message > 0){
+            if (message == 1){
+                error = 5;
+            }
+
+            if (message == 2){
+                error = 6;
+            }
+
+            if (message == 3){
+                error = 7;
+            }
+            //reset
+            message = 0;
+        }
+
+        // Print grid to screen
+        printGrid(sudoku, error, savestate);
+
+        // Get user input and validate
+        memset(input, '\0', 64);
+        fgets(input, 63, stdin);
+        error = validate(input, 1, savestate);
+
+        // Reprint the grid if there are errors
+        if(error != 0 && error != 9){
+
+            // Keep printing until input is properly inputted
+            while(error != 0){
+
+                printGrid(sudoku, error, savestate);
+
+                memset(input, '\0', 64);
+                fgets(input, 63, stdin);
+                error = validate(input, 1, savestate);
+
+                // Break if user requests the menu
+                if(error == 9){
+                    break;
+                }
+            }
+        }
+
+        // Enter the menu
+        if (error == 9){
+
+            printGrid(sudoku, error, savestate);
+            memset(input, '\0', 64);
+            fgets(input, 63, stdin);
+
+
+            while(validate(input, 2, savestate) != 0){
+
+                printGrid(sudoku, error, savestate);
+                memset(input, '\0', 64);
+                fgets(input, 63, stdin);
+
+            }
+
+            // Reset board
+            if(input[0] == '1'){
+                for (int i = 0; i < 9; i++){
+                    for (int j = 0; j < 9; j++){
+                        sudoku[i][j] = savestate[i][j];
+                        message = 1;
+                    }
+                }
+            }
+
+            // Solve Puzzle!
+            if(input[0] == '2'){
+
+                // Reset board to solve the puzzle
+                for (int i = 0; i < 9; i++){
+                    for (int j = 0; j < 9; j++){
+                        sudoku[i][j] = savestate[i][j];
+                        //message = 1;
+                    }
+                }
+
+                // Find out whether a solution exists before animating the search
+                int check[9][9];
+                memcpy(check, savestate, sizeof(check));
+
+                if(solveDeadline(check, 0) == SOLVE_UNSOLVABLE){
+                    message = 3;
+                }
+                else{
+                    // Record the backtracking search at full speed, then draw it.
+                    // The check above already settled whether a solution exists,
+                    // so stop at the first one rather than look for a second.
+                    Trace * trace = newTrace(sudoku);
+                    SolveState state;
+
+                    initSearch(&state, ENGINE_LINEAR);
+                    state.solutionLimit = 1;
+                    state.trace = trace;
+                    runSearch(&state, sudoku, 0);
+                    solved = 1;
+
+                    if(trace != NULL){
+                        int grid[81];
+                        long long position = trace->first;
+
+                        memcpy(grid, trace->base, sizeof(grid));
+                        animateTrace(trace, grid, &position, trace->solvedAt, 0);
+                        freeTrace(trace);
+                    }
+
+                    printGrid(sudoku, 10, savestate);
+
+                    printf("\033[0;32m");
+                    printf("\n\n\t\t\t\tPuzzle has been solved by computer!");
+                    printf("\033[0;0m");
+                    printf("\n(exited)\n");
+                }
+            }
+
+            // Check solution
+            if(input[0] == '4'){
+
+                solved = checkSolution(sudoku);
+
+                if(solved == 1){
+                    printf("\033[0;32m");
+                    printf("\n\t\t\t\t\tYou've done it!\nThx4Playing!\n");
+                    printf("\033[0;0m");
+                    printf("\n(exited)\n");
+                }
+                else{
+                    message = 2;
+                }
+            }
+
+            // Quit game
+            if(input[0] == '5'){
+                for(int i = 0; i < 80; i++){
+                    printf("\n");
+                }
+                printf("(Exited)\nThx4playing\n");
+                quit = 1;
+            }
+        }
+
+        // Regular command
+        if(error == 0){
+
+            // Process input
+            int x, y, num = 0;
+            x = atoi(strtok(input, " "));
+            y = atoi(strtok(NULL, " "));
+            num = atoi(strtok(NULL, " \n\0"));
+
+            // Depth of grid
+            y = 9 - y;
+            // Span of grid
+            x = x - 1;
+
+            sudoku[y][x] = num;
+        }
+    }
+}
+
+// CHECK SOLUTION - Check grid for final correctness
+// @param
+//  - The sudoku grid to be checked
+// Returns BOOLEAN INT
+//  - 0 if unsolved, 1 if solved
+int checkSolution(int sudoku[9][9]){
+
+    // This array will be populated with the ints from the user's sudoku grid in each row/col in ascending order before being checked
+    int array[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    // Check that all rows do not have repeated integers
+    for (int i = 0; i < 9; i++){
+        for (int j = 0; j < 9; j++){
+
+            // Check for any blank spaces
+            if(sudoku[i][j] == 0){
+                return 0;
+            }
+            // Place the integer in the array in sorted order
+            else{
+                array[sudoku[i][j] - 1] = sudoku[i][j];
+            }
+        }
+
+        // Check that the array contains the ints 1-9 in ascending order
+        for(int j = 0; j < 9; j++){
+            // ex. '1' should be in the zeroeth slot
+            int k = j + 1;
+            if(array[j] != k){
+                // fail
+                return 0;
+            }
+        }
+
+        // reset array
+        for(int j = 0; j < 9; j++){
+            array[j] = 0;
+        }
+    }
+
+    // Check that all columns do not have repeated integers
+    for (int i = 0; i < 9; i++){
+        for (int j = 0; j < 9; j++){
+            // Same logic checked by the column inverse
+            array[sudoku[j][i] - 1] = sudoku[j][i];
+        }
+
+        // Check array
+        for(int j = 0; j < 9; j++){
+            int k = j + 1;
+            if(array[j] != k){
+                return 0;
+            }
+        }
+
+        // reset array
+        for(int j = 0; j < 9; j++){
+            array[j] = 0;
+        }
+    }
+
+    // Check all nine squares for repeating integers
+    if(checkSingleSquare(0, 0, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(0, 3, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(0, 6, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(3, 0, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(6, 0, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(3, 3, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(3, 6, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(6, 3, sudoku) == 0){
+        return 0;
+    }
+    if(checkSingleSquare(6, 6, sudoku) == 0){
+        return 0;
+    }
+    
+    // Return solved after all checks are passed
+    return 1;
+}
+
+// CHECK SINGLE SQUARE - Checks a single sudoku square for correctness
+// @params
+//  - int y - the y-coordinate of the top-left square to be verified
+//  - int x - the x-coordinate of the top-left square to be verified
+//  - sudoku[][] - the sudoku grid
+int checkSingleSquare(int y, int x, int sudoku[9][9]){
+
+    // Generate 9-space array to be filled by each square
+    int array[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    // Extract all nine integers and place in array in order
+    for(int i = y; i < y + 3; i++){
+        for(int j = x; j < x + 3; j++){
+            // Ensure each box contains each in 1-9
+            array[sudoku[i][j] - 1] = sudoku[i][j];
+        }
+    }
+
+    // Check that all nine spots are filled
+    for(int j = 0; j < 9; j++){
+        int k = j + 1;
+        if(array[j] != k){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// CHECK GIVENS - Checks a loaded grid for values out of range or repeated
+//   in a row, column or square, in a single pass over the grid
+// @params
+//  - sudoku - the 9x9 grid to be checked, 0 for blank spaces
+// Returns BOOLEAN INT
+//  - 0 if the givens are consistent, 1 otherwise
+int checkGivens(int sudoku[9][9]){
+
+    unsigned short rows[9] = {0}, cols[9] = {0}, boxes[9] = {0};
+
+    for(int i = 0; i < 9; i++){
+        for(int j = 0; j < 9; j++){
+
+            int num = sudoku[i][j];
+
+            if(num == 0){
+                continue;
+            }
+            if(num < 0 || num > 9){
+                return 1;
+            }
+
+            unsigned short bit = 1 << (num - 1);
+            int box = (i / 3) * 3 + j / 3;
+
+            if((rows[i] | cols[j] | boxes[box]) & bit){
+                return 1;
+            }
+
+            rows[i] |= bit;
+            cols[j] |= bit;
+            boxes[box] |= bit;
+        }
+    }
+
+    return 0;
+}
+
+// READ FILE - Reads a single sudoku file and populates 2D array with integers
+// @params
+//  - sudoku - 9x9 sudoku grid, initialized to zero
+//  - filename - the name of the sudoku file to be extracted
+// Returns INT
+//  - SOLVE_SOLVED (0) if the file loaded, SOLVE_MALFORMED if it does not
+//    hold exactly 9 lines of 9 values or the givens break the rules
+int readFile(int sudoku[9][9], char * filename){
+
+    // Open file and check for error
+    FILE * inFD = fopen(filename, "r");
+    if(inFD == NULL){
+        printf("Failed to open file %s\n", filename);
+        exit(EXIT_ERROR);
+    }
+
+    char line[128];
+    memset(line, '\0', 128);
+
+    char * token = NULL;
+    int index = 0;
+    int status = SOLVE_SOLVED;
+
+    // Begin reading file
+    while(status == SOLVE_SOLVED && fgets(line, 127, inFD)){
+
+        // Get first value on single line
+        token = strtok(line, " \r\n");
+
+        // Trailing blank lines are allowed, anything past the grid is not
+        if(token == NULL && index >= 9){
+            continue;
+        }
+        if(index >= 9){
+            status = SOLVE_MALFORMED;
+            break;
+        }
+
+        // Populate all 9 integers on the line, x is a blank space
+        for(int i = 0; i < 9; i++){
+
+            if(i > 0){
+                token = strtok(NULL, " \r\n");
+            }
+
+            if(token == NULL || strlen(token) != 1){
+                status = SOLVE_MALFORMED;
+                break;
+            }
+
+            if(strcmp(token, "x") == 0){
+                sudoku[index][i] = 0;
+            }
+            else if(token[0] >= '1' && token[0] <= '9'){
+                sudoku[index][i] = token[0] - '0';
+            }
+            else{
+                status = SOLVE_MALFORMED;
+                break;
+            }
+        }
+
+        // Extra values on the line
+        if(status == SOLVE_SOLVED && strtok(NULL, " \r\n") != NULL){
+            status = SOLVE_MALFORMED;
+        }
+
+        memset(line, '\0', 128);
+        index++;
+    }
+
+    // Close file
+    fclose(inFD);
+
+    if(status == SOLVE_SOLVED && index < 9){
+        status = SOLVE_MALFORMED;
+    }
+
+    // Reject conflicting givens at load rather than after a full search
+    if(status == SOLVE_SOLVED && checkGivens(sudoku) != 0){
+        status = SOLVE_MALFORMED;
+    }
+
+    return status;
+}
+
+// PARSE LINE - Reads a puzzle from a single corpus line
+// @params
+//  - line - 81 characters, 1-9 for givens and '.', '0' or 'x' for blanks
+//  - sudoku - 9x9 grid to be populated
+// Returns INT
+//  - SOLVE_SOLVED (0) if the line loaded, SOLVE_MALFORMED otherwise
+int parseLine(char * line, int sudoku[9][9]){
+
+    // remove trailing newline from line
+    line[strcspn(line, "\r\n")] = 0;
+
+    memset(sudoku, 0, sizeof(int) * 81);
+
+    if(strlen(line) != 81){
+        return SOLVE_MALFORMED;
+    }
+
+    for(int i = 0; i < 81; i++){
+        char c = line[i];
+
+        if(c >= '1' && c <= '9'){
+            sudoku[i / 9][i % 9] = c - '0';
+        }
+        else if(c != '.' && c != '0' && c != 'x'){
+            memset(sudoku, 0, sizeof(int) * 81);
+            return SOLVE_MALFORMED;
+        }
+    }
+
+    if(checkGivens(sudoku) != 0){
+        return SOLVE_MALFORMED;
+    }
+
+    return SOLVE_SOLVED;
+}
+
+// READ JOURNAL - Finds the last checkpoint in a shard's journal
+// - Reading stops at the first line torn by a crash (no trailing newline)
+//   or otherwise unreadable, everything from there on is ignored
+// @params
+//  - journal - open journal file, positioned at the start
+//  - header - the header line this run would write, to detect a journal
+//    left by a different corpus or shard layout. An empty string accepts
+//    any header and is filled with it, the buffer must hold 128 bytes.
+//  - checkpoint - filled with the last checkpoint found
+//  - goodEnd - set to the byte offset just after the last good line, 0 if
+//    not even the header is whole
+// Returns INT
+//  - -1 if the journal belongs to a different run, 0 if it holds no
+//    checkpoint, 1 for a checkpoint and 2 if the shard is complete
+int readJournal(FILE * journal, char * header, Checkpoint * checkpoint, long long * goodEnd){
+
+    char line[256];
+    char word[16];
+    Checkpoint read;
+    int found = 0;
+
+    *goodEnd = 0;
+
+    // Empty journal or torn header, the shard has not started
+    if(fgets(line, sizeof(line), journal) == NULL || strchr(line, '\n') == NULL){
+        return 0;
+    }
+    if(header[0] == 0 && strlen(line) < 128){
+        strcpy(header, line);
+    }
+    if(strcmp(line, header) != 0){
+        return -1;
+    }
+    *goodEnd = ftello(journal);
+
+    while(fgets(line, sizeof(line), journal)){
+
+        if(strchr(line, '\n') == NULL){
+            break;
+        }
+
+        if(sscanf(line, "%15s %lld %lld %lld %ld %ld %ld %ld %ld", word,
+                    &read.records, &read.inOffset, &read.outBytes,
+                    &read.counts[0], &read.counts[1], &read.counts[2],
+                    &read.counts[3], &read.counts[4]) != 9){
+            break;
+        }
+
+        *checkpoint = read;
+        *goodEnd = ftello(journal);
+        found = strcmp(word, "complete") == 0 ? 2 : 1;
+    }
+
+    return found;
+}
+
+// WRITE CHECKPOINT - Makes completed records durable and journals them
+// - Output is flushed and synced before the journal line is appended, so
+//   a journal line never points past output that reached the disk
+// @params
+//  - out - output buffer holding the shard's unwritten records
+//  - journalFD - journal opened for appending
+//  - word - "done" for a periodic checkpoint, "complete" at the end
+//  - checkpoint - progress to be recorded
+void writeCheckpoint(OutBuffer * out, int journalFD, char * word, Checkpoint * checkpoint){
+
+    char line[256];
+
+    outFlush(out);
+    if(fsync(out->fd) != 0){
+        perror("fsync");
+        exit(EXIT_ERROR);
+    }
+
+    int len = snprintf(line, sizeof(line), "%s %lld %lld %lld %ld %ld %ld %ld %ld\n", word,
+            checkpoint->records, checkpoint->inOffset, checkpoint->outBytes,
+            checkpoint->counts[0], checkpoint->counts[1], checkpoint->counts[2],
+            checkpoint->counts[3], checkpoint->counts[4]);
+
+    if(write(journalFD, line, len) != len){
+        perror("write");
+        exit(EXIT_ERROR);
+    }
+    if(fsync(journalFD) != 0){
+        perror("fsync");
+        exit(EXIT_ERROR);
+    }
+}
+
+// FINGERPRINT CORPUS - Hashes the first and last blocks of a corpus
+// - Catches a journal being resumed against a different corpus of the
+//   same size, which fixed-width records make likely
+// @params
+//  - inFD - the open corpus, left at an unspecified position
+//  - size - corpus size in bytes
+// Returns
+//  - 64-bit FNV-1a hash of the first and last FINGERPRINT_BLOCK bytes
+unsigned long long fingerprintCorpus(FILE * inFD, long long size){
+
+    unsigned long long hash = 14695981039346656037ULL;
+    long long starts[2] = { 0, size > FINGERPRINT_BLOCK ? size - FINGERPRINT_BLOCK : 0 };
+    int c;
+
+    for(int i = 0; i < 2; i++){
+        fseeko(inFD, starts[i], SEEK_SET);
+        for(long long n = 0; n < FINGERPRINT_BLOCK && (c = fgetc(inFD)) != EOF; n++){
+            hash = (hash ^ (unsigned char) c) * 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+// RUN BATCH - Solves every puzzle in a corpus file
+// - Writes one fixed-size record per corpus line, in corpus order, and a
+//   count of each result code to stderr
+// - A sharded run takes the records starting inside its share of the
+//   corpus bytes, writes them to [out].[shard] and journals progress to
+//   [out].[shard].journal every CHECKPOINT_RECORDS records. Rerunning the
+//   same shard resumes from its last checkpoint, or does nothing once the
+//   shard has completed.
+// @params
+//  - corpus - name of the corpus file, one puzzle per line
+//  - outName - file to write records to, or NULL for the terminal
+//  - binary - 1 for binary records, 0 for text
+//  - deadlineMs - time budget for each puzzle, 0 for no limit
+//  - shard - index of this shard, from 0
+//  - shards - number of shards, 0 for an unsharded run
+// Returns INT
+//  - 0 on success, EXIT_ERROR if the files could not be opened or the journal
+//    belongs to a different run
+int runBatch(char * corpus, char * outName, int binary, long deadlineMs, int shard, int shards){
+
+    FILE * inFD = fopen(corpus, "r");
+    if(inFD == NULL){
+        fprintf(stderr, "Failed to open file %s\n", corpus);
+        return EXIT_ERROR;
+    }
+
+    int recordSize = binary ? RECORD_BINARY_SIZE : RECORD_TEXT_SIZE;
+    int outFlags = O_WRONLY | O_CREAT | O_TRUNC;
+    int journalFD = -1;
+    char outPath[4096];
+    char header[128];
+    Checkpoint checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+
+    // Byte range of the corpus belonging to this shard
+    fseeko(inFD, 0, SEEK_END);
+    long long size = ftello(inFD);
+    long long start = 0;
+    long long end = size;
+
+    if(shards > 0){
+
+        start = size * shard / shards;
+        end = size * (shard + 1) / shards;
+
+        // Records belong to the shard their first byte falls in
+        if(start > 0){
+            int c;
+            fseeko(inFD, start - 1, SEEK_SET);
+            while((c = fgetc(inFD)) != '\n' && c != EOF);
+            start = ftello(inFD);
+        }
+        checkpoint.inOffset = start;
+
+        snprintf(outPath, sizeof(outPath), "%s.%d.journal", outName, shard);
+        snprintf(header, sizeof(header), "shard %d %d %lld %d %016llx\n", shard, shards, size,
+                recordSize, fingerprintCorpus(inFD, size));
+
+        FILE * journal = fopen(outPath, "r");
+        int found = 0;
+        long long goodEnd = 0;
+
+        if(journal != NULL){
+            found = readJournal(journal, header, &checkpoint, &goodEnd);
+            fclose(journal);
+        }
+
+        if(found < 0){
+            fprintf(stderr, "Journal %s belongs to a different corpus or shard layout\n", outPath);
+            fclose(inFD);
+            return EXIT_ERROR;
+        }
+
+        // Output lost or cut short since its last checkpoint cannot be
+        // resumed, start the shard again from scratch
+        struct stat info;
+        snprintf(outPath, sizeof(outPath), "%s.%d", outName, shard);
+
+        if(found > 0 && (stat(outPath, &info) != 0 || info.st_size < checkpoint.outBytes)){
+            fprintf(stderr, "Shard %d output is shorter than its journal, restarting the shard\n", shard);
+            memset(&checkpoint, 0, sizeof(checkpoint));
+            checkpoint.inOffset = start;
+            found = 0;
+            goodEnd = 0;
+        }
+        snprintf(outPath, sizeof(outPath), "%s.%d.journal", outName, shard);
+
+        // Nothing left to do for a completed shard
+        if(found == 2){
+            fprintf(stderr, "Shard %d already complete\n", shard);
+            fprintf(stderr, "solved %ld, unsolvable %ld, multiple %ld, timeout %ld, malformed %ld\n",
+                    checkpoint.counts[0], checkpoint.counts[1], checkpoint.counts[2],
+                    checkpoint.counts[3], checkpoint.counts[4]);
+            fclose(inFD);
+            return 0;
+        }
+
+        journalFD = open(outPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if(journalFD < 0){
+            fprintf(stderr, "Failed to open file %s\n", outPath);
+            fclose(inFD);
+            return EXIT_ERROR;
+        }
+
+        // Drop anything after the last good line so new checkpoints start on
+        // a line of their own, and record which run a fresh journal belongs to
+        if(ftruncate(journalFD, goodEnd) != 0){
+            perror("ftruncate");
+            exit(EXIT_ERROR);
+        }
+        if(goodEnd == 0 && write(journalFD, header, strlen(header)) != (ssize_t) strlen(header)){
+            perror("write");
+            exit(EXIT_ERROR);
+        }
+
+        // Keep records up to the checkpoint, drop any written after it
+        outFlags = O_WRONLY | O_CREAT;
+
+        snprintf(outPath, sizeof(outPath), "%s.%d", outName, shard);
+        outName = outPath;
+    }
+
+    int outFD = STDOUT_FILENO;
+    if(outName != NULL){
+        outFD = open(outName, outFlags, 0644);
+        if(outFD < 0){
+            fprintf(stderr, "Failed to open file %s\n", outName);
+            fclose(inFD);
+            return EXIT_ERROR;
+        }
+        if(shards > 0 && (ftruncate(outFD, checkpoint.outBytes) != 0
+                    || lseek(outFD, checkpoint.outBytes, SEEK_SET) != checkpoint.outBytes)){
+            perror("ftruncate");
+            exit(EXIT_ERROR);
+        }
+    }
+
+    fseeko(inFD, checkpoint.inOffset, SEEK_SET);
+
+    OutBuffer * out = malloc(sizeof(OutBuffer));
+    out->fd = outFD;
+    out->used = 0;
+
+    char line[128];
+    int sudoku[9][9];
+
+    while(ftello(inFD) < end && fgets(line, sizeof(line), inFD)){
+
+        // Overlong line, skip the rest of it and report it as malformed
+        if(strchr(line, '\n') == NULL && !feof(inFD)){
+            int c;
+            while((c = fgetc(inFD)) != '\n' && c != EOF);
+            line[0] = 0;
+        }
+
+        int status = parseLine(line, sudoku);
+
+        if(status == SOLVE_SOLVED){
+            status = solveDeadline(sudoku, deadlineMs);
+        }
+
+        outRecord(out, sudoku, status, binary);
+        checkpoint.counts[status]++;
+        checkpoint.records++;
+
+        if(journalFD >= 0 && checkpoint.records % CHECKPOINT_RECORDS == 0){
+            checkpoint.inOffset = ftello(inFD);
+            checkpoint.outBytes = checkpoint.records * recordSize;
+            writeCheckpoint(out, journalFD, "done", &checkpoint);
+        }
+    }
+
+    if(journalFD >= 0){
+        checkpoint.inOffset = ftello(inFD);
+        checkpoint.outBytes = checkpoint.records * recordSize;
+        writeCheckpoint(out, journalFD, "complete", &checkpoint);
+        close(journalFD);
+    }
+
+    outFlush(out);
+    free(out);
+    fclose(inFD);
+
+    if(outName != NULL){
+        close(outFD);
+    }
+
+    fprintf(stderr, "solved %ld, unsolvable %ld, multiple %ld, timeout %ld, malformed %ld\n",
+            checkpoint.counts[0], checkpoint.counts[1], checkpoint.counts[2],
+            checkpoint.counts[3], checkpoint.counts[4]);
+
+    return 0;
+}
+
+// RUN MERGE - Joins the outputs of a sharded batch run
+// - Shards are appended in shard order, which is corpus order, so the
+//   result matches an unsharded run byte for byte. Every shard's journal
+//   must show it completed, its header must name the same shard count,
+//   corpus size, corpus fingerprint and record size, and its output must be exactly as long
+//   as the journal says. The merged file is written under a temporary
+//   name and renamed into place once whole.
+// @params
+//  - outName - the --out name the shards were run with
+//  - shards - number of shards
+// Returns INT
+//  - 0 on success, EXIT_ERROR if a shard is missing, incomplete or from another run
+int runMerge(char * outName, int shards){
+
+    char path[4096];
+    char header[128];
+    int status = 0;
+    int shardsFound = 0;
+    long long size = 0, firstSize = 0;
+    int recordSize = 0, firstRecordSize = 0;
+    unsigned long long fingerprint = 0, firstFingerprint = 0;
+
+    // Check every shard finished before writing anything
+    for(int i = 0; i < shards && status == 0; i++){
+
+        Checkpoint checkpoint;
+        long long goodEnd;
+        int shard = -1;
+        int found = 0;
+        struct stat info;
+
+        snprintf(path, sizeof(path), "%s.%d.journal", outName, i);
+        FILE * journal = fopen(path, "r");
+
+        header[0] = 0;
+        if(journal != NULL){
+            found = readJournal(journal, header, &checkpoint, &goodEnd);
+            fclose(journal);
+        }
+
+        if(found != 2){
+            fprintf(stderr, "Shard %d of %s has not completed\n", i, outName);
+            status = EXIT_ERROR;
+            break;
+        }
+
+        if(sscanf(header, "shard %d %d %lld %d %llx", &shard, &shardsFound, &size,
+                    &recordSize, &fingerprint) != 5
+                || shard != i || shardsFound != shards){
+            fprintf(stderr, "Shard %d of %s is not shard %d of %d\n", i, outName, i, shards);
+            status = EXIT_ERROR;
+            break;
+        }
+
+        // Every shard must come from the same corpus and record format
+        if(i == 0){
+            firstSize = size;
+            firstRecordSize = recordSize;
+            firstFingerprint = fingerprint;
+        }
+        else if(size != firstSize || recordSize != firstRecordSize || fingerprint != firstFingerprint){
+            fprintf(stderr, "Shard %d of %s is from a different corpus or record format\n", i, outName);
+            status = EXIT_ERROR;
+            break;
+        }
+
+        snprintf(path, sizeof(path), "%s.%d", outName, i);
+        if(stat(path, &info) != 0 || info.st_size != checkpoint.outBytes){
+            fprintf(stderr, "Shard %d of %s output is not the %lld bytes its journal records\n",
+                    i, outName, checkpoint.outBytes);
+            status = EXIT_ERROR;
+        }
+    }
+
+    if(status != 0){
+        return status;
+    }
+
+    snprintf(path, sizeof(path), "%s.tmp", outName);
+    int outFD = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(outFD < 0){
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return EXIT_ERROR;
+    }
+
+    OutBuffer * out = malloc(sizeof(OutBuffer));
+    out->fd = outFD;
+
+    for(int i = 0; i < shards && status == 0; i++){
+
+        snprintf(path, sizeof(path), "%s.%d", outName, i);
+        int inFD = open(path, O_RDONLY);
+        if(inFD < 0){
+            fprintf(stderr, "Failed to open file %s\n", path);
+            status = EXIT_ERROR;
+            break;
+        }
+
+        // Read straight into the output buffer and write it out whole
+        ssize_t n;
+        while((n = read(inFD, out->data, OUT_BUFFER_SIZE)) > 0){
+            out->used = n;
+            outFlush(out);
+        }
+        if(n < 0){
+            perror("read");
+            status = EXIT_ERROR;
+        }
+
+        close(inFD);
+    }
+
+    if(fsync(outFD) != 0){
+        perror("fsync");
+        status = EXIT_ERROR;
+    }
+    close(outFD);
+    free(out);
+
+    // Only a whole merge replaces the output, a failed one is discarded
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", outName);
+
+    if(status == 0 && rename(tmp, outName) != 0){
+        perror("rename");
+        status = EXIT_ERROR;
+    }
+    if(status != 0){
+        unlink(tmp);
+    }
+
+    return status;
+}
+
+// OPEN COUNTERS - Opens the hardware counters used by --perf as one group
+// - Counters the kernel or CPU refuses are left out rather than failing,
+//   so the report shows what is available, down to wall time only
+// @params
+//  - group - filled with the counter file descriptors
+// Returns INT
+//  - Number of counters opened
+int openCounters(PerfGroup * group){
+
+    unsigned int types[PERF_COUNTERS] = {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE,
+    };
+    unsigned long long configs[PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    };
+    int opened = 0;
 
-            // Quit game
-            if(input[0] == '5'){
-                for(int i = 0; i < 80; i++){
-                    printf("\n");
-                }
-                printf("(Exited)\nThx4playing\n");
-                quit = 1;
+    group->leader = -1;
+
+    for(int i = 0; i < PERF_COUNTERS; i++){
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = group->leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        group->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, group->leader, 0);
+
+        if(group->fd[i] >= 0){
+            if(group->leader < 0){
+                group->leader = group->fd[i];
             }
+            opened++;
         }
+    }
 
-        // Regular command
-        if(error == 0){
+    return opened;
+}
 
-            // Process input
-            int x, y, num = 0;
-            x = atoi(strtok(input, " "));
-            y = atoi(strtok(NULL, " "));
-            num = atoi(strtok(NULL, " \n\0"));
+// READ COUNTERS - Reads every open counter in the group
+// @params
+//  - group - counters opened by openCounters
+//  - values - filled with each counter's value, 0 where unavailable
+void readCounters(PerfGroup * group, unsigned long long values[PERF_COUNTERS]){
 
-            // Depth of grid
-            y = 9 - y;
-            // Span of grid
-            x = x - 1;
+    // Group read layout: number of counters followed by their values
+    unsigned long long data[PERF_COUNTERS + 1];
+    int next = 1;
 
-            sudoku[y][x] = num;
+    memset(values, 0, sizeof(unsigned long long) * PERF_COUNTERS);
+
+    if(group->leader < 0 || read(group->leader, data, sizeof(data)) <= 0){
+        return;
+    }
+
+    for(int i = 0; i < PERF_COUNTERS; i++){
+        if(group->fd[i] >= 0 && next <= (int) data[0]){
+            values[i] = data[next++];
         }
     }
 }
 
-// CHECK SOLUTION - Check grid for final correctness
-// @param
-//  - The sudoku grid to be checked
-// Returns BOOLEAN INT
-//  - 0 if unsolved, 1 if solved
-int checkSolution(int sudoku[9][9]){
+// RUN PERF - Profiles each solving engine and the recursive solvePuzzle on
+//   every puzzle in a corpus
+// - Each solve is wrapped in the hardware counter group and the monotonic
+//   clock. Results are summed per engine and per difficulty bucket, where
+//   the bucket is chosen by the number of givens.
+// @params
+//  - corpus - name of the corpus file, one puzzle per line
+//  - deadlineMs - time budget for each solve, 0 for no limit
+// Returns INT
+//  - 0 on success, EXIT_ERROR if the corpus could not be opened
+int runPerf(char * corpus, long deadlineMs){
+
+    char buckets[PERF_BUCKETS][16] = {
+        "36+ givens",
+        "30-35 givens",
+        "25-29 givens",
+        "<25 givens",
+    };
+    char counterNames[PERF_COUNTERS][16] = {
+        "cycles",
+        "instructions",
+        "branch-misses",
+        "L1d-misses",
+    };
 
-    // This array will be populated with the ints from the user's sudoku grid in each row/col in ascending order before being checked
-    int array[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    FILE * inFD = fopen(corpus, "r");
+    if(inFD == NULL){
+        fprintf(stderr, "Failed to open file %s\n", corpus);
+        return EXIT_ERROR;
+    }
 
-    // Check that all rows do not have repeated integers
-    for (int i = 0; i < 9; i++){
-        for (int j = 0; j < 9; j++){
+    PerfGroup group;
+    int available = openCounters(&group);
 
-            // Check for any blank spaces
-            if(sudoku[i][j] == 0){
-                return 0;
+    if(available == 0){
+        fprintf(stderr, "Hardware counters unavailable, reporting wall time only\n");
+    }
+
+    // Per engine and bucket: puzzle count, wall nanoseconds, search nodes,
+    // then counters. The last row is the recursive solvePuzzle.
+    unsigned long long totals[ENGINES + 1][PERF_BUCKETS][PERF_COUNTERS + 3];
+    memset(totals, 0, sizeof(totals));
+
+    char line[128];
+    int puzzle[9][9];
+    int sudoku[9][9];
+
+    while(fgets(line, sizeof(line), inFD)){
+
+        if(parseLine(line, puzzle) != SOLVE_SOLVED){
+            continue;
+        }
+
+        int givens = 0;
+        for(int i = 0; i < 81; i++){
+            givens += puzzle[i / 9][i % 9] != 0;
+        }
+        int bucket = givens >= 36 ? 0 : givens >= 30 ? 1 : givens >= 25 ? 2 : 3;
+
+        for(int engine = 0; engine <= ENGINES; engine++){
+
+            unsigned long long values[PERF_COUNTERS];
+            struct timespec begin, end;
+            SolveState state;
+
+            memcpy(sudoku, puzzle, sizeof(sudoku));
+            initSearch(&state, engine);
+
+            if(group.leader >= 0){
+                ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
             }
-            // Place the integer in the array in sorted order
-            else{
-                array[sudoku[i][j] - 1] = sudoku[i][j];
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+
+            if(engine < ENGINES){
+                runSearch(&state, sudoku, deadlineMs);
+            }
+            else if(checkGivens(sudoku) == 0){
+                startDeadline(&state, deadlineMs);
+                solvePuzzle(sudoku, 0, 0, &state);
             }
-        }
 
-        // Check that the array contains the ints 1-9 in ascending order
-        for(int j = 0; j < 9; j++){
-            // ex. '1' should be in the zeroeth slot
-            int k = j + 1;
-            if(array[j] != k){
-                // fail
-                return 0;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if(group.leader >= 0){
+                ioctl(group.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
             }
-        }
 
-        // reset array
-        for(int j = 0; j < 9; j++){
-            array[j] = 0;
+            readCounters(&group, values);
+
+            unsigned long long * total = totals[engine][bucket];
+            total[0]++;
+            total[1] += (end.tv_sec - begin.tv_sec) * 1000000000ULL + end.tv_nsec - begin.tv_nsec;
+            total[2] += state.nodes;
+            for(int i = 0; i < PERF_COUNTERS; i++){
+                total[i + 3] += values[i];
+            }
         }
     }
 
-    // Check that all columns do not have repeated integers
-    for (int i = 0; i < 9; i++){
-        for (int j = 0; j < 9; j++){
-            // Same logic checked by the column inverse
-            array[sudoku[j][i] - 1] = sudoku[j][i];
+    fclose(inFD);
+
+    for(int i = 0; i < PERF_COUNTERS; i++){
+        if(group.fd[i] >= 0){
+            close(group.fd[i]);
         }
+    }
 
-        // Check array
-        for(int j = 0; j < 9; j++){
-            int k = j + 1;
-            if(array[j] != k){
-                return 0;
+    // Report averages per puzzle
+    printf("%-10s %-13s %8s %12s %12s", "engine", "bucket", "puzzles", "wall-us", "nodes");
+    for(int i = 0; i < PERF_COUNTERS; i++){
+        printf(" %14s", counterNames[i]);
+    }
+    printf(" %6s %10s\n", "IPC", "instr/node");
+
+    for(int engine = 0; engine <= ENGINES; engine++){
+        for(int bucket = 0; bucket < PERF_BUCKETS; bucket++){
+
+            unsigned long long * total = totals[engine][bucket];
+
+            if(total[0] == 0){
+                continue;
             }
-        }
 
-        // reset array
-        for(int j = 0; j < 9; j++){
-            array[j] = 0;
+            printf("%-10s %-13s %8llu %12.1f %12.0f",
+                    engine < ENGINES ? engineNames[engine] : "backtrack", buckets[bucket],
+                    total[0], total[1] / 1000.0 / total[0], (double) total[2] / total[0]);
+
+            for(int i = 0; i < PERF_COUNTERS; i++){
+                if(group.fd[i] >= 0){
+                    printf(" %14.0f", (double) total[i + 3] / total[0]);
+                }
+                else{
+                    printf(" %14s", "n/a");
+                }
+            }
+
+            // Instructions per cycle
+            if(group.fd[0] >= 0 && group.fd[1] >= 0 && total[3] > 0){
+                printf(" %6.2f", (double) total[4] / total[3]);
+            }
+            else{
+                printf(" %6s", "n/a");
+            }
+
+            // Instructions per search node
+            if(group.fd[1] >= 0 && total[2] > 0){
+                printf(" %10.1f\n", (double) total[4] / total[2]);
+            }
+            else{
+                printf(" %10s\n", "n/a");
+            }
         }
     }
 
-    // Check all nine squares for repeating integers
-    if(checkSingleSquare(0, 0, sudoku) == 0){
-        return 0;
-    }
-    if(checkSingleSquare(0, 3, sudoku) == 0){
-        return 0;
+    return 0;
+}
+
+// NEW TRACE - Allocates an empty trace ring for recording a search
+// @params
+//  - sudoku - the puzzle about to be searched
+// Returns
+//  - The trace, or NULL if out of memory
+Trace * newTrace(int sudoku[9][9]){
+
+    Trace * trace = malloc(sizeof(Trace));
+    if(trace == NULL){
+        return NULL;
     }
-    if(checkSingleSquare(0, 6, sudoku) == 0){
-        return 0;
+
+    trace->events = malloc(sizeof(unsigned short) * TRACE_EVENTS);
+    if(trace->events == NULL){
+        free(trace);
+        return NULL;
     }
-    if(checkSingleSquare(3, 0, sudoku) == 0){
-        return 0;
+
+    trace->capacity = TRACE_EVENTS;
+    trace->first = 0;
+    trace->count = 0;
+    trace->solvedAt = -1;
+
+    for(int i = 0; i < 81; i++){
+        trace->givens[i] = sudoku[i / 9][i % 9];
+        trace->base[i] = sudoku[i / 9][i % 9];
     }
-    if(checkSingleSquare(6, 0, sudoku) == 0){
-        return 0;
+
+    return trace;
+}
+
+// FREE TRACE - Releases a trace from newTrace or loadTrace
+// @params
+//  - trace - the trace, may be NULL
+void freeTrace(Trace * trace){
+
+    if(trace != NULL){
+        free(trace->events);
+        free(trace);
     }
-    if(checkSingleSquare(3, 3, sudoku) == 0){
-        return 0;
+}
+
+// APPLY EVENT - Moves a grid one event forward or back through a trace
+// @params
+//  - grid - 81 cells in row-major order
+//  - event - packed trace event
+//  - forward - 1 to apply the event, 0 to reverse it
+void applyEvent(int grid[81], unsigned short event, int forward){
+
+    int i = (event >> 4) & 0x7F;
+    int num = event & 0xF;
+    int undo = event >> 15;
+
+    // Placing forward or undoing backward leaves the digit in the cell
+    grid[i] = undo != forward ? num : 0;
+}
+
+// TRACE EVENT - Records one place or undo in a trace ring
+// - Once the ring is full the oldest event is folded into the base grid
+//   before its slot is reused, so the retained events still replay
+// @params
+//  - trace - trace being recorded, capacity TRACE_EVENTS
+//  - i - cell index in row-major order
+//  - num - digit placed or removed
+//  - undo - 0 for a placement, 1 for an undo
+void traceEvent(Trace * trace, int i, int num, int undo){
+
+    long long slot = trace->count & (TRACE_EVENTS - 1);
+
+    if(trace->count - trace->first == TRACE_EVENTS){
+        applyEvent(trace->base, trace->events[slot], 1);
+        trace->first++;
     }
-    if(checkSingleSquare(3, 6, sudoku) == 0){
-        return 0;
+
+    trace->events[slot] = (undo << 15) | (i << 4) | num;
+    trace->count++;
+}
+
+// SAVE TRACE - Writes a trace to a file
+// - Layout, in host byte order: the TRACE_MAGIC string, 81 given bytes,
+//   81 base grid bytes, the first, count and solvedAt event numbers as
+//   64-bit integers, then every retained event oldest first
+// @params
+//  - traceName - name of the file to write
+//  - trace - the recorded trace
+// Returns INT
+//  - 0 on success, 1 if the file could not be written
+int saveTrace(char * traceName, Trace * trace){
+
+    char header[TRACE_HEADER_SIZE];
+    long long numbers[3] = { trace->first, trace->count, trace->solvedAt };
+
+    memcpy(header, TRACE_MAGIC, 8);
+    for(int i = 0; i < 81; i++){
+        header[8 + i] = trace->givens[i];
+        header[89 + i] = trace->base[i];
     }
-    if(checkSingleSquare(6, 3, sudoku) == 0){
-        return 0;
+    memcpy(header + 170, numbers, sizeof(numbers));
+
+    int outFD = open(traceName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(outFD < 0){
+        fprintf(stderr, "Failed to open file %s\n", traceName);
+        return 1;
     }
-    if(checkSingleSquare(6, 6, sudoku) == 0){
-        return 0;
+
+    // Header and both halves of the ring go out in one writev
+    long long start = trace->first % trace->capacity;
+    long long held = trace->count - trace->first;
+    long long tail = held < trace->capacity - start ? held : trace->capacity - start;
+
+    struct iovec iov[3] = {
+        { header, TRACE_HEADER_SIZE },
+        { trace->events + start, tail * sizeof(unsigned short) },
+        { trace->events, (held - tail) * sizeof(unsigned short) },
+    };
+    size_t total = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+
+    int status = writev(outFD, iov, 3) == (ssize_t) total ? 0 : 1;
+
+    if(status != 0){
+        fprintf(stderr, "Failed to write file %s\n", traceName);
     }
-    
-    // Return solved after all checks are passed
-    return 1;
+
+    close(outFD);
+
+    return status;
 }
 
-// CHECK SINGLE SQUARE - Checks a single sudoku square for correctness
+// LOAD TRACE - Reads a trace written by saveTrace
+// - Every field is checked, so a damaged file can never make a replay
+//   write outside the grid
 // @params
-//  - int y - the y-coordinate of the top-left square to be verified
-//  - int x - the x-coordinate of the top-left square to be verified
-//  - sudoku[][] - the sudoku grid
-int checkSingleSquare(int y, int x, int sudoku[9][9]){
+//  - traceName - name of the file to read
+// Returns
+//  - The trace, or NULL if the file is missing, damaged or not a trace
+Trace * loadTrace(char * traceName){
 
-    // Generate 9-space array to be filled by each square
-    int array[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    char header[TRACE_HEADER_SIZE];
+    long long numbers[3];
 
-    // Extract all nine integers and place in array in order
-    for(int i = y; i < y + 3; i++){
-        for(int j = x; j < x + 3; j++){
-            // Ensure each box contains each in 1-9
-            array[sudoku[i][j] - 1] = sudoku[i][j];
-        }
+    FILE * inFD = fopen(traceName, "rb");
+    if(inFD == NULL){
+        return NULL;
     }
 
-    // Check that all nine spots are filled
-    for(int j = 0; j < 9; j++){
-        int k = j + 1;
-        if(array[j] != k){
-            return 0;
+    if(fread(header, 1, TRACE_HEADER_SIZE, inFD) != TRACE_HEADER_SIZE
+            || memcmp(header, TRACE_MAGIC, 8) != 0){
+        fclose(inFD);
+        return NULL;
+    }
+    memcpy(numbers, header + 170, sizeof(numbers));
+
+    long long held = numbers[1] - numbers[0];
+    int valid = numbers[0] >= 0 && held >= 0 && held <= TRACE_EVENTS
+            && numbers[2] >= -1 && numbers[2] <= numbers[1];
+
+    for(int i = 0; i < 162; i++){
+        valid = valid && header[8 + i] >= 0 && header[8 + i] <= 9;
+    }
+
+    if(!valid){
+        fclose(inFD);
+        return NULL;
+    }
+
+    Trace * trace = malloc(sizeof(Trace));
+    if(trace == NULL){
+        fclose(inFD);
+        return NULL;
+    }
+    trace->events = malloc(sizeof(unsigned short) * (held > 0 ? held : 1));
+    if(trace->events == NULL){
+        free(trace);
+        fclose(inFD);
+        return NULL;
+    }
+    trace->capacity = held > 0 ? held : 1;
+    trace->first = numbers[0];
+    trace->count = numbers[1];
+    trace->solvedAt = numbers[2];
+
+    for(int i = 0; i < 81; i++){
+        trace->givens[i] = header[8 + i];
+        trace->base[i] = header[89 + i];
+    }
+
+    // Event k lives in slot k % capacity, as in a recording ring. Events
+    // must name a cell on the grid and a digit 1-9.
+    for(long long k = trace->first; k < trace->count; k++){
+        unsigned short event;
+        if(fread(&event, sizeof(event), 1, inFD) != 1
+                || ((event >> 4) & 0x7FF) >= 81 || (event & 0xF) < 1 || (event & 0xF) > 9){
+            freeTrace(trace);
+            fclose(inFD);
+            return NULL;
         }
+        trace->events[k % trace->capacity] = event;
     }
 
-    return 1;
+    fclose(inFD);
+
+    return trace;
 }
 
-// READ FILE - Reads a single sudoku file and populates 2D array with integers
+// SEEK TRACE - Moves a replay grid to any event of a trace
 // @params
-//  - sudoku - 9x9 sudoku grid, initialized to zero
-//  - filename - the name of the sudoku file to be extracted
-void readFile(int sudoku[9][9], char * filename){
+//  - trace - the trace being replayed
+//  - grid - 81 cells showing the grid after *position events
+//  - position - current event number, updated to the target
+//  - target - event number to move to, clamped to the events held
+void seekTrace(Trace * trace, int grid[81], long long * position, long long target){
+
+    if(target < trace->first){
+        target = trace->first;
+    }
+    if(target > trace->count){
+        target = trace->count;
+    }
 
-    // Open file and check for error
-    FILE * inFD = fopen(filename, "r");
-    if(inFD == NULL){
-        printf("Failed to open file %s\n", filename);
-        exit(1);
+    while(*position < target){
+        applyEvent(grid, trace->events[*position % trace->capacity], 1);
+        (*position)++;
+    }
+    while(*position > target){
+        (*position)--;
+        applyEvent(grid, trace->events[*position % trace->capacity], 0);
     }
+}
 
-    char line[128];
-    memset(line, '\0', 128);
+// ANIMATE TRACE - Draws a trace event by event up to a target event
+// @params
+//  - trace - the trace being replayed
+//  - grid - 81 cells showing the grid after *position events
+//  - position - current event number, updated to the target
+//  - target - last event to draw
+//  - delayMs - pause between frames in milliseconds
+void animateTrace(Trace * trace, int grid[81], long long * position, long long target, long delayMs){
 
-    char * token = NULL;
-    int index = 0;
+    int view[9][9];
+    int givens[9][9];
+    struct timespec delay = { delayMs / 1000, (delayMs % 1000) * 1000000 };
 
-    // Begin reading file
-    while(fgets(line, 127, inFD)){
+    memcpy(givens, trace->givens, sizeof(givens));
+
+    while(*position < target && *position < trace->count){
 
-        // Get first number on single line
-        token = strtok(line, " \n");
+        seekTrace(trace, grid, position, *position + 1);
+        memcpy(view, grid, sizeof(view));
 
-        // Populate space if not zero
-        if(strcmp(token, "x") != 0){
-            sudoku[index][0] = atoi(token);
+        // Live feed of solving!
+        printGrid(view, 11, givens);
+
+        if(delayMs > 0){
+            nanosleep(&delay, NULL);
         }
+    }
+}
+
+// RUN REPLAY - Interactive viewer for a recorded trace
+// - Commands, one per line: [enter] or 'f N' steps forward, 'b [N]' steps
+//   back, 'g N' seeks to event N, 'p [N]' plays forward, 'q' quits
+// @params
+//  - traceName - name of the trace file
+//  - delayMs - pause between frames when playing
+// Returns INT
+//  - 0 on success, EXIT_ERROR if the trace could not be loaded
+int runReplay(char * traceName, long delayMs){
 
-        // Populate remaining 8 integers on the line
-        for(int i = 1; i < 9; i++){
+    Trace * trace = loadTrace(traceName);
+    if(trace == NULL){
+        printf("Failed to load trace %s\n", traceName);
+        return EXIT_ERROR;
+    }
+
+    int grid[81];
+    int view[9][9];
+    int givens[9][9];
+    char input[64];
+    long long position = trace->first;
 
-            token = strtok(NULL, " \n");
+    memcpy(grid, trace->base, sizeof(grid));
+    memcpy(givens, trace->givens, sizeof(givens));
 
-            if(strcmp(token, "x") != 0){
+    while(1){
 
-                sudoku[index][i] = atoi(token);
-            }
+        memcpy(view, grid, sizeof(view));
+        printGrid(view, 11, givens);
+        outFormat(&screen, "\n\t\t\tEvent %lld of %lld", position, trace->count);
+        if(trace->solvedAt >= 0){
+            outFormat(&screen, " (solved at %lld)", trace->solvedAt);
         }
+        outText(&screen, "\n\t\t\t[enter] step, f N, b N, g N, p N, q\t> ");
+        outFlush(&screen);
 
-        memset(line, '\0', 128);
-        index++;
+        memset(input, '\0', 64);
+        if(fgets(input, 63, stdin) == NULL){
+            break;
+        }
+        input[strcspn(input, "\n")] = 0;
+
+        char command = input[0];
+        long long count = strlen(input) > 2 ? atoll(input + 2) : 1;
+
+        if(command == 'q'){
+            break;
+        }
+        else if(command == 'b'){
+            seekTrace(trace, grid, &position, position - count);
+        }
+        else if(command == 'g'){
+            seekTrace(trace, grid, &position, count);
+        }
+        else if(command == 'p'){
+            animateTrace(trace, grid, &position,
+                    strlen(input) > 2 ? position + count : trace->count, delayMs);
+        }
+        else if(command == 'f' || command == 0){
+            seekTrace(trace, grid, &position, position + count);
+        }
     }
 
-    // Close file
-    fclose(inFD);
+    printf("\n");
+    freeTrace(trace);
+
+    return 0;
 }